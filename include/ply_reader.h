@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
 
 #include "trimesh_types.h"
 #include "trimesh.h"
@@ -13,21 +14,39 @@ class PlyReader
 {
 public:
 
-    static void loadPlyFile(const std::string& filename, trimesh::trimesh_t& outMesh)
+    // Returns false if the file can't be read, is truncated, has no faces, has a face that is not
+    // a triangle of distinct, in-range vertex indices, or uses a directed edge in more than one
+    // face (duplicate faces, flipped neighbors, non-manifold edges); 'outMesh' is then left unchanged.
+    static bool loadPlyFile(const std::string& filename, trimesh::trimesh_t& outMesh)
+    {
+        trimesh::build_workspace_t workspace;
+        return loadPlyFile(filename, outMesh, workspace);
+    }
+
+    // Same as above, but stages vertices, triangles and edges in 'workspace' and builds
+    // through it, so loading many files in a row reuses the same memory.
+    // If 'outHasNormals' is given, it is set to whether the file has vertex normals.
+    static bool loadPlyFile(const std::string& filename, trimesh::trimesh_t& outMesh, trimesh::build_workspace_t& workspace, bool* outHasNormals = nullptr)
     {
         using namespace trimesh;
 
-        std::vector<vertex_t> vertices;
-        std::vector<triangle_t> triangles;
-        std::vector<edge_t> edges;
+        std::vector<vertex_t>& vertices = workspace.vertices;
+        std::vector<triangle_t>& triangles = workspace.triangles;
+        std::vector<edge_t>& edges = workspace.edges;
+        vertices.clear();
+        triangles.clear();
+        edges.clear();
 
         std::ifstream file(filename);
         if (!file.is_open())
         {
             std::cerr << "Error: Could not open the file " << filename << std::endl;
-            return;
+            return false;
         }
 
+        // One line buffer for the whole file; it keeps its capacity between lines.
+        // Data lines are parsed with strtof/strtol: istream's float extraction
+        // allocates a scratch string for every value.
         std::string line;
         bool header = true;
         int vertexCount = 0, faceCount = 0;
@@ -35,10 +54,10 @@ public:
 
         while (std::getline(file, line))
         {
-            std::istringstream iss(line);
-
             if (header)
             {
+                std::istringstream iss(line);
+
                 if (line.find("element vertex") != std::string::npos)
                 {
                     iss.ignore(15);
@@ -68,17 +87,24 @@ public:
                 else if (line == "end_header")
                 {
                     header = false;
+                    vertices.reserve(vertexCount);
+                    triangles.reserve(faceCount);
                 }
             }
             else if (vertexCount > 0)
             {
+                const char* cursor = line.c_str();
                 vertex_t vertex;
-                iss >> vertex.x >> vertex.y >> vertex.z;
+                vertex.x = readFloat(cursor);
+                vertex.y = readFloat(cursor);
+                vertex.z = readFloat(cursor);
 
                 if (hasColor)
                 {
-                    int r, g, b;
-                    iss >> r >> g >> b;
+                    long r = 0, g = 0, b = 0;
+                    readInt(cursor, r);
+                    readInt(cursor, g);
+                    readInt(cursor, b);
                     vertex.r = static_cast<unsigned char>(r);
                     vertex.g = static_cast<unsigned char>(g);
                     vertex.b = static_cast<unsigned char>(b);
@@ -86,12 +112,14 @@ public:
 
                 if (hasNormals)
                 {
-                    iss >> vertex.nx >> vertex.ny >> vertex.nz;
+                    vertex.nx = readFloat(cursor);
+                    vertex.ny = readFloat(cursor);
+                    vertex.nz = readFloat(cursor);
                 }
 
                 if (hasCurvature)
                 {
-                    iss >> vertex.curvature;
+                    vertex.curvature = readFloat(cursor);
                 }
 
                 vertices.push_back(vertex);
@@ -99,15 +127,24 @@ public:
             }
             else if (faceCount > 0)
             {
+                // Only triangles whose indices refer to loaded vertices can be built;
+                // anything else rejects the whole file.
+                const char* cursor = line.c_str();
                 triangle_t face;
-                int vertexIndices;
-                iss >> vertexIndices; // number of vertices in this face
-                for (int i = 0; i < vertexIndices; i++)
+                long vertexIndices = 0; // number of vertices in this face
+                bool valid = readInt(cursor, vertexIndices) && vertexIndices == 3;
+                for (int i = 0; valid && i < 3; i++)
                 {
-                    int index;
-                    iss >> index;
+                    long index = -1;
+                    valid = readInt(cursor, index) && index >= 0 && index < static_cast<long>(vertices.size());
                     face.v[i] = index;
                 }
+                valid = valid && face.v[0] != face.v[1] && face.v[1] != face.v[2] && face.v[2] != face.v[0];
+                if (!valid)
+                {
+                    std::cerr << "Error: Invalid face \"" << line << "\" in the file " << filename << std::endl;
+                    return false;
+                }
                 triangles.push_back(face);
                 faceCount--;
             }
@@ -115,12 +152,33 @@ public:
 
         file.close();
 
-        trimesh::unordered_edges_from_triangles(triangles.size(), &triangles[0], edges);
+        if (vertexCount > 0 || faceCount > 0)
+        {
+            std::cerr << "Error: Unexpected end of the file " << filename << std::endl;
+            return false;
+        }
+
+        if (triangles.empty())
+        {
+            std::cerr << "Error: No faces in the file " << filename << std::endl;
+            return false;
+        }
 
-        outMesh.build(vertices.size(), &vertices[0], triangles.size(), &triangles[0], edges.size(), &edges[0]);
+        if (!trimesh::directed_edges_are_unique(triangles.size(), triangles.data(), workspace))
+        {
+            std::cerr << "Error: A directed edge is used by more than one face in the file " << filename << std::endl;
+            return false;
+        }
+
+        trimesh::unordered_edges_from_triangles(triangles.size(), triangles.data(), edges, workspace);
+
+        outMesh.build(vertices.size(), vertices.data(), triangles.size(), triangles.data(), edges.size(), edges.data(), workspace);
+        if (outHasNormals) *outHasNormals = hasNormals;
+        return true;
     }
 
-    static void savePlyFile(const std::string &filename, const trimesh::trimesh_t& mesh)
+    // Returns false if the file could not be written.
+    static bool savePlyFile(const std::string &filename, const trimesh::trimesh_t& mesh)
     {
         using namespace trimesh;
 
@@ -128,7 +186,7 @@ public:
         if (!file.is_open())
         {
             std::cerr << "Error: Could not open the file " << filename << " for writing." << std::endl;
-            return;
+            return false;
         }
 
         // Write the PLY header
@@ -180,5 +238,28 @@ public:
         }
 
         file.close();
+        return !file.fail();
+    }
+
+private:
+
+    // Parse one number at 'cursor' and advance it past the number.
+    static float readFloat(const char*& cursor)
+    {
+        char* end;
+        const float value = std::strtof(cursor, &end);
+        cursor = end;
+        return value;
+    }
+
+    // Returns false, leaving 'value' untouched, if there is no integer at 'cursor'.
+    static bool readInt(const char*& cursor, long& value)
+    {
+        char* end;
+        const long parsed = std::strtol(cursor, &end, 10);
+        if (end == cursor) return false;
+        value = parsed;
+        cursor = end;
+        return true;
     }
-};
\ No newline at end of file
+};
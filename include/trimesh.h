@@ -1,6 +1,7 @@
 #pragma once
 
 #include "trimesh_types.h" // triangle_t, edge_t
+#include "trimesh_workspace.h" // build_workspace_t
 #include <vector>
 #include <map>
 
@@ -9,6 +10,14 @@ namespace trimesh
 
 // trimesh_t::build() needs the unordered edges of the mesh.  If you don't have them, call this first.
 void unordered_edges_from_triangles( const unsigned long num_triangles, const trimesh::triangle_t* triangles, std::vector< trimesh::edge_t >& edges_out );
+// As above, but the temporary edge set is allocated from 'workspace's arena.
+void unordered_edges_from_triangles( const unsigned long num_triangles, const trimesh::triangle_t* triangles, std::vector< trimesh::edge_t >& edges_out, build_workspace_t& workspace );
+
+// trimesh_t::build() needs every directed edge (i,j) to belong to at most one triangle:
+// no duplicate triangles, no inconsistently oriented neighbors and no edges shared by
+// more than two triangles.  Returns whether 'triangles' satisfies this.
+// The temporary edge list is allocated from 'workspace's arena.
+bool directed_edges_are_unique( const unsigned long num_triangles, const trimesh::triangle_t* triangles, build_workspace_t& workspace );
 
 class trimesh_t
 {
@@ -20,6 +29,10 @@ public:
     // NOTE: 'triangles' and 'edges' are not needed after the call to build()
     //       completes and may be destroyed.
     void build(const unsigned long num_vertices, const vertex_t *vertices, const unsigned long num_triangles, const trimesh::triangle_t *triangles, const unsigned long num_edges, const trimesh::edge_t *edges);
+    // As above, but reuses 'workspace' for all temporaries and recycles this mesh's
+    // existing storage instead of freeing it.  Pass the same workspace to repeated
+    // builds to avoid heap allocations once it has warmed up.
+    void build(const unsigned long num_vertices, const vertex_t *vertices, const unsigned long num_triangles, const trimesh::triangle_t *triangles, const unsigned long num_edges, const trimesh::edge_t *edges, build_workspace_t& workspace);
 
     void clear()
     {
@@ -28,10 +41,18 @@ public:
         m_face_halfedges.clear();
         m_edge_halfedges.clear();
         m_directed_edge2he_index.clear();
+        m_vertices_data_map.clear();
     }
     
     const halfedge_t& halfedge( const index_t i ) const { return m_halfedges.at( i ); }
     
+    // Element counts, and the index of one halfedge inside face 'face_index'.
+    // Unlike vertices(), triangles() and halfEdges(), these don't copy any array.
+    index_t num_vertices() const { return static_cast<index_t>( m_vertex_halfedges.size() ); }
+    index_t num_faces() const { return static_cast<index_t>( m_face_halfedges.size() ); }
+    index_t num_edges() const { return static_cast<index_t>( m_edge_halfedges.size() ); }
+    index_t face_halfedge( const index_t face_index ) const { return m_face_halfedges[ face_index ]; }
+    
     std::pair< index_t, index_t > he_index2directed_edge( const index_t he_index ) const
     {
         /*
@@ -149,6 +170,9 @@ public:
     std::vector< std::pair< index_t, index_t > > boundary_edges() const;
 
     inline vertices_data_map vertices_data() const { return m_vertices_data_map; }
+    inline const vertex_t& vertex_data( const index_t vertex_index ) const { return m_vertices_data_map.at( vertex_index ); }
+    // Replaces the attributes (position, color, normal, ...) of a vertex; the topology is unchanged.
+    inline void set_vertex_data( const index_t vertex_index, const vertex_t& data ) { m_vertices_data_map.at( vertex_index ) = data; }
     inline std::vector<index_t> vertices() const { return m_vertex_halfedges; }
     inline std::vector<index_t> triangles() const { return m_face_halfedges; }
     inline std::vector<halfedge_t> halfEdges() const { return m_halfedges; }
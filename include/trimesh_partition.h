@@ -0,0 +1,50 @@
+#pragma once
+
+#include "trimesh.h"
+#include <vector>
+
+namespace trimesh
+{
+
+// One piece of a partitioned mesh, built as a stand-alone trimesh_t.
+struct mesh_patch_t
+{
+    trimesh_t mesh;
+    // Global vertex index of each local vertex of 'mesh'.
+    std::vector< index_t > vertex_local2global;
+    // Global face index of each local face of 'mesh'.
+    std::vector< index_t > face_local2global;
+    // Local vertices that are also used by faces of other patches.
+    // Results computed at these vertices must be reconciled when stitching.
+    std::vector< index_t > interface_vertices;
+    // Global indices of the faces outside the patch that share a vertex with it, i.e. the
+    // rest of the one-ring of every interface vertex.  With them a worker can finish
+    // per-vertex work (normals, smoothing, ...) at its interface vertices.
+    std::vector< index_t > halo_faces;
+};
+
+struct mesh_partition_t
+{
+    // Patch index of every global face.
+    std::vector< index_t > face_patch;
+    std::vector< mesh_patch_t > patches;
+};
+
+// Assigns every face of 'mesh' to one of 'num_patches' patches of (nearly) equal size.
+// Patches are grown region by region across the face-face adjacency (opposite_he),
+// starting from seeds spread out by farthest-point sampling of the face centroids.
+// A patch only takes faces edge-adjacent to faces it already has, so on a connected
+// mesh every patch is edge-connected.  Faces a full patch boxes in go to an adjacent
+// patch even past the target size, so sizes are balanced but not exact.
+// NOTE: Seeds are sampled from at most 65536 evenly strided faces, so seeding costs
+//       O(num_patches * 65536) on large meshes and num_patches is capped at that count.
+// NOTE: Each connected component that received no seed is added whole to the
+//       smallest patch, which then consists of one piece per such component.
+// NOTE: A patch may touch itself at a single vertex; building it then reports a butterfly vertex.
+void partition_faces( const trimesh_t& mesh, const unsigned long num_patches, std::vector< index_t >& face_patch_out );
+
+// Partitions 'mesh' with partition_faces() and exports every patch as its own
+// trimesh_t together with its local-to-global maps, interface vertices and halo faces.
+void partition_mesh( const trimesh_t& mesh, const unsigned long num_patches, mesh_partition_t& partition_out );
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "trimesh_types.h" // vertex_t, triangle_t, edge_t
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <memory_resource>
+
+namespace trimesh
+{
+
+class trimesh_t;
+
+// Scratch state that can be kept alive across many calls to trimesh_t::build()
+// (and unordered_edges_from_triangles()) so that repeated builds stop going to the heap.
+// - Temporaries (the directed-edge-to-face map, the boundary sets, ...) are served
+//   from a monotonic arena over a buffer owned by the workspace.  The buffer grows
+//   to fit the largest build seen so far and is then reused as-is.
+// - Vectors and map nodes are kept around with their capacity instead of being freed.
+// NOTE: A workspace is not thread-safe.  Give each thread its own; builds on
+//       different threads then never touch a shared allocator in steady state.
+class build_workspace_t
+{
+public:
+    explicit build_workspace_t( const std::size_t initial_arena_bytes = 0 ) : m_arena_buffer( initial_arena_bytes ) {}
+
+    build_workspace_t( const build_workspace_t& ) = delete;
+    build_workspace_t& operator=( const build_workspace_t& ) = delete;
+
+    // Staging buffers for loaders (e.g. PlyReader) that collect vertices, triangles
+    // and edges before calling build().  Their capacity is retained between files.
+    std::vector< vertex_t > vertices;
+    std::vector< triangle_t > triangles;
+    std::vector< edge_t > edges;
+
+    // Size in bytes of the retained arena buffer.
+    std::size_t arena_capacity() const { return m_arena_buffer.size(); }
+
+    // Frees all retained memory.
+    void release()
+    {
+        std::vector< vertex_t >().swap( vertices );
+        std::vector< triangle_t >().swap( triangles );
+        std::vector< edge_t >().swap( edges );
+        std::vector< index_t >().swap( m_boundary_heis );
+        std::vector< std::byte >().swap( m_arena_buffer );
+        m_edge_nodes.clear();
+        m_edge_nodes.shrink_to_fit();
+    }
+
+    // A monotonic arena over the workspace's buffer.  Memory handed out by resource()
+    // is valid until the scope is destroyed.  If the buffer was too small, the arena
+    // falls back to the heap and the buffer is enlarged on destruction so the next
+    // build of the same size fits.
+    class arena_scope_t
+    {
+    public:
+        explicit arena_scope_t( build_workspace_t& workspace )
+            : m_workspace( workspace ),
+              m_arena( workspace.m_arena_buffer.data(), workspace.m_arena_buffer.size(), &m_overflow )
+        {}
+
+        ~arena_scope_t()
+        {
+            m_arena.release();
+            if( m_overflow.bytes > 0 )
+            {
+                m_workspace.m_arena_buffer.resize( m_workspace.m_arena_buffer.size() + m_overflow.bytes );
+            }
+        }
+
+        arena_scope_t( const arena_scope_t& ) = delete;
+        arena_scope_t& operator=( const arena_scope_t& ) = delete;
+
+        std::pmr::memory_resource* resource() { return &m_arena; }
+
+    private:
+        // Upstream of the arena; counts how many bytes did not fit in the buffer.
+        struct overflow_counter_t : public std::pmr::memory_resource
+        {
+            std::size_t bytes = 0;
+
+            void* do_allocate( std::size_t bytes_requested, std::size_t alignment ) override
+            {
+                bytes += bytes_requested;
+                return std::pmr::new_delete_resource()->allocate( bytes_requested, alignment );
+            }
+            void do_deallocate( void* p, std::size_t bytes_requested, std::size_t alignment ) override
+            {
+                std::pmr::new_delete_resource()->deallocate( p, bytes_requested, alignment );
+            }
+            bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        build_workspace_t& m_workspace;
+        // Declared before m_arena, which uses it as its upstream.
+        overflow_counter_t m_overflow;
+        std::pmr::monotonic_buffer_resource m_arena;
+    };
+
+private:
+    friend class trimesh_t;
+
+    std::vector< std::byte > m_arena_buffer;
+    // Boundary halfedge indices collected during build().
+    std::vector< index_t > m_boundary_heis;
+    // Nodes recycled from a mesh's directed-edge map, re-keyed and re-inserted by the next build().
+    std::vector< std::map< std::pair< index_t, index_t >, index_t >::node_type > m_edge_nodes;
+};
+
+}
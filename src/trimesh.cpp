@@ -4,15 +4,18 @@
 #include <cassert>
 #include <set>
 #include <iostream>
+#include <type_traits>
+#include <algorithm>
 
 namespace
 {
-typedef std::map< std::pair< trimesh::index_t, trimesh::index_t >, trimesh::index_t > directed_edge2index_map_t;
-trimesh::index_t directed_edge2face_index( const directed_edge2index_map_t& de2fi, trimesh::index_t vertex_i, trimesh::index_t vertex_j )
+// Temporary maps live in the build workspace's arena.
+typedef std::pmr::map< std::pair< trimesh::index_t, trimesh::index_t >, trimesh::index_t > directed_edge2face_map_t;
+trimesh::index_t directed_edge2face_index( const directed_edge2face_map_t& de2fi, trimesh::index_t vertex_i, trimesh::index_t vertex_j )
 {
     assert( !de2fi.empty() );
     
-    directed_edge2index_map_t::const_iterator it = de2fi.find( { vertex_i, vertex_j } );
+    directed_edge2face_map_t::const_iterator it = de2fi.find( { vertex_i, vertex_j } );
     
     // If no such directed edge exists, then there's no such face in the mesh.
     // The edge must be a boundary edge.
@@ -31,6 +34,12 @@ namespace trimesh
 {
 
 void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertices, const unsigned long num_triangles, const triangle_t* triangles, const unsigned long num_edges, const edge_t* edges )
+{
+    build_workspace_t workspace;
+    build( num_vertices, vertices, num_triangles, triangles, num_edges, edges, workspace );
+}
+
+void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertices, const unsigned long num_triangles, const triangle_t* triangles, const unsigned long num_edges, const edge_t* edges, build_workspace_t& workspace )
 {
     /*
     Generates all half edge data structures for the mesh given by its vertices 'self.vs'
@@ -42,7 +51,12 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
     assert( triangles );
     assert( edges );
     
-    directed_edge2index_map_t de2fi;
+    static_assert( std::is_same< directed_edge2index_map_t::node_type, decltype( workspace.m_edge_nodes )::value_type >::value,
+                   "build_workspace_t::m_edge_nodes must hold nodes of trimesh_t::directed_edge2index_map_t" );
+    
+    build_workspace_t::arena_scope_t arena( workspace );
+    
+    directed_edge2face_map_t de2fi( arena.resource() );
     for( int fi = 0; fi < num_triangles; ++fi )
     {
         const triangle_t& tri = triangles[fi];
@@ -51,7 +65,32 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
         de2fi[ { tri.v[2], tri.v[0] } ] = fi;
     }
     
-    clear();
+    // Keep the nodes of the previous directed edge map; they are re-keyed below
+    // instead of being freed and allocated again.
+    std::vector< directed_edge2index_map_t::node_type >& edge_nodes = workspace.m_edge_nodes;
+    while( !m_directed_edge2he_index.empty() )
+    {
+        edge_nodes.push_back( m_directed_edge2he_index.extract( m_directed_edge2he_index.begin() ) );
+    }
+    const auto insert_directed_edge = [&]( const index_t i, const index_t j, const index_t he_index )
+    {
+        if( edge_nodes.empty() )
+        {
+            m_directed_edge2he_index[ { i, j } ] = he_index;
+            return;
+        }
+        
+        directed_edge2index_map_t::node_type node = std::move( edge_nodes.back() );
+        edge_nodes.pop_back();
+        node.key() = { i, j };
+        node.mapped() = he_index;
+        m_directed_edge2he_index.insert( std::move( node ) );
+    };
+    
+    m_halfedges.clear();
+    m_vertex_halfedges.clear();
+    m_face_halfedges.clear();
+    m_edge_halfedges.clear();
     m_vertex_halfedges.resize( num_vertices, -1 );
     m_face_halfedges.resize( num_triangles, -1 );
     m_edge_halfedges.resize( num_edges, -1 );
@@ -87,8 +126,8 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
         // Also store the index in our m_directed_edge2he_index map.
         assert( m_directed_edge2he_index.find( { edge.v[0], edge.v[1] } ) == m_directed_edge2he_index.end() );
         assert( m_directed_edge2he_index.find( { edge.v[1], edge.v[0] } ) == m_directed_edge2he_index.end() );
-        m_directed_edge2he_index[ { edge.v[0], edge.v[1] } ] = he0index;
-        m_directed_edge2he_index[ { edge.v[1], edge.v[0] } ] = he1index;
+        insert_directed_edge( edge.v[0], edge.v[1], he0index );
+        insert_directed_edge( edge.v[1], edge.v[0], he1index );
         
         // If the vertex pointed to by a half-edge doesn't yet have an out-going
         // halfedge, store the opposite halfedge.
@@ -126,7 +165,8 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
     
     // Now that all the half-edges are created, set the remaining next_he field.
     // We can't yet handle boundary halfedges, so store them for later.
-    std::vector< index_t > boundary_heis;
+    std::vector< index_t >& boundary_heis = workspace.m_boundary_heis;
+    boundary_heis.clear();
     for( int hei = 0; hei < m_halfedges.size(); ++hei )
     {
         halfedge_t& he = m_halfedges.at( hei );
@@ -146,12 +186,15 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
         else if( face.v[2] == i ) j = face.v[0];
         assert( -1 != j );
         
-        he.next_he = m_directed_edge2he_index[ { i, j } ];
+        directed_edge2index_map_t::const_iterator next = m_directed_edge2he_index.find( { i, j } );
+        assert( next != m_directed_edge2he_index.end() );
+        he.next_he = next->second;
     }
     
     // Make a map from vertices to boundary halfedges (indices) originating from them.
     // NOTE: There will only be multiple originating boundary halfedges at butterfly vertices.
-    std::map< index_t, std::set< index_t > > vertex2outgoing_boundary_hei;
+    typedef std::pmr::map< index_t, std::pmr::set< index_t > > vertex2outgoing_boundary_hei_t;
+    vertex2outgoing_boundary_hei_t vertex2outgoing_boundary_hei( arena.resource() );
     for( std::vector< index_t >::const_iterator hei = boundary_heis.begin(); hei != boundary_heis.end(); ++hei )
     {
         const index_t originating_vertex = m_halfedges[ m_halfedges[ *hei ].opposite_he ].to_vertex;
@@ -168,24 +211,36 @@ void trimesh_t::build( const unsigned long num_vertices, const vertex_t* vertice
     {
         halfedge_t& he = m_halfedges[ *hei ];
         
-        std::set< index_t >& outgoing = vertex2outgoing_boundary_hei[ he.to_vertex ];
+        std::pmr::set< index_t >& outgoing = vertex2outgoing_boundary_hei[ he.to_vertex ];
         if( !outgoing.empty() )
         {
-            std::set< index_t >::iterator outgoing_hei = outgoing.begin();
+            std::pmr::set< index_t >::iterator outgoing_hei = outgoing.begin();
             he.next_he = *outgoing_hei;
             
             outgoing.erase( outgoing_hei );
         }
     }
 
-    // Populate vertex map with data for algorithms usage
+    // Populate vertex map with data for algorithms usage.
+    // Entries left over from a previous build are overwritten in place, so
+    // rebuilding a mesh of the same size doesn't touch the allocator.
+    vertices_data_map::iterator data_it = m_vertices_data_map.begin();
     for(size_t i = 0; i < num_vertices; i++)
     {
-        m_vertices_data_map[i] = vertices[i];
+        if( data_it != m_vertices_data_map.end() && data_it->first == static_cast<index_t>(i) )
+        {
+            data_it->second = vertices[i];
+            ++data_it;
+        }
+        else
+        {
+            data_it = std::next( m_vertices_data_map.insert_or_assign( data_it, i, vertices[i] ) );
+        }
     }
+    m_vertices_data_map.erase( data_it, m_vertices_data_map.end() );
     
 #ifndef NDEBUG
-    for( std::map< index_t, std::set< index_t > >::const_iterator it = vertex2outgoing_boundary_hei.begin(); it != vertex2outgoing_boundary_hei.end(); ++it )
+    for( vertex2outgoing_boundary_hei_t::const_iterator it = vertex2outgoing_boundary_hei.begin(); it != vertex2outgoing_boundary_hei.end(); ++it )
     {
         assert( it->second.empty() );
     }
@@ -238,10 +293,35 @@ std::vector< std::pair< index_t, index_t > > trimesh_t::boundary_edges() const
     return result;
 }
 
+bool directed_edges_are_unique( const unsigned long num_triangles, const triangle_t* triangles, build_workspace_t& workspace )
+{
+    build_workspace_t::arena_scope_t arena( workspace );
+    
+    std::pmr::vector< std::pair< index_t, index_t > > directed_edges( arena.resource() );
+    directed_edges.reserve( 3*num_triangles );
+    for( unsigned long t = 0; t < num_triangles; ++t )
+    {
+        directed_edges.push_back( { triangles[t].i(), triangles[t].j() } );
+        directed_edges.push_back( { triangles[t].j(), triangles[t].k() } );
+        directed_edges.push_back( { triangles[t].k(), triangles[t].i() } );
+    }
+    
+    std::sort( directed_edges.begin(), directed_edges.end() );
+    return std::adjacent_find( directed_edges.begin(), directed_edges.end() ) == directed_edges.end();
+}
+
 void unordered_edges_from_triangles( const unsigned long num_triangles, const triangle_t* triangles, std::vector< edge_t >& edges_out )
 {
-    typedef std::set< std::pair< index_t, index_t > > edge_set_t;
-    edge_set_t edges;
+    build_workspace_t workspace;
+    unordered_edges_from_triangles( num_triangles, triangles, edges_out, workspace );
+}
+
+void unordered_edges_from_triangles( const unsigned long num_triangles, const triangle_t* triangles, std::vector< edge_t >& edges_out, build_workspace_t& workspace )
+{
+    build_workspace_t::arena_scope_t arena( workspace );
+    
+    typedef std::pmr::set< std::pair< index_t, index_t > > edge_set_t;
+    edge_set_t edges( arena.resource() );
     for( int t = 0; t < num_triangles; ++t )
     {
         edges.insert( { std::min( triangles[t].i(), triangles[t].j() ), std::max( triangles[t].i(), triangles[t].j() ) } );
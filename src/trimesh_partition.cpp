@@ -0,0 +1,332 @@
+#include "trimesh_partition.h"
+
+// needed for implementation
+#include <cassert>
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <limits>
+
+namespace
+{
+void face_vertices( const trimesh::trimesh_t& mesh, const trimesh::index_t face_index, trimesh::index_t vertices_out[3] )
+{
+    const trimesh::halfedge_t& he0 = mesh.halfedge( mesh.face_halfedge( face_index ) );
+    const trimesh::halfedge_t& he1 = mesh.halfedge( he0.next_he );
+    const trimesh::halfedge_t& he2 = mesh.halfedge( he1.next_he );
+    vertices_out[0] = he0.to_vertex;
+    vertices_out[1] = he1.to_vertex;
+    vertices_out[2] = he2.to_vertex;
+}
+
+void face_face_neighbors( const trimesh::trimesh_t& mesh, const trimesh::index_t face_index, trimesh::index_t neighbors_out[3] )
+{
+    /*
+    Returns in 'neighbors_out' the faces across the three edges of face 'face_index'.
+    Boundary edges give -1.
+    */
+
+    trimesh::index_t hei = mesh.face_halfedge( face_index );
+    for( int i = 0; i < 3; ++i )
+    {
+        const trimesh::halfedge_t& he = mesh.halfedge( hei );
+        neighbors_out[i] = mesh.halfedge( he.opposite_he ).face;
+        hei = he.next_he;
+    }
+}
+
+std::vector< trimesh::vertex_t > vertex_data_array( const trimesh::trimesh_t& mesh )
+{
+    const trimesh::vertices_data_map data = mesh.vertices_data();
+
+    std::vector< trimesh::vertex_t > result( mesh.num_vertices() );
+    for( const auto& [id, vertex] : data )
+    {
+        result.at( id ) = vertex;
+    }
+    return result;
+}
+
+// partition_faces() given the mesh's vertex data as an array.
+// Returns the number of patches actually used.
+trimesh::index_t partition_faces( const trimesh::trimesh_t& mesh, const std::vector< trimesh::vertex_t >& vertices, const unsigned long num_patches, std::vector< trimesh::index_t >& face_patch_out )
+{
+    using namespace trimesh;
+
+    const index_t num_faces = mesh.num_faces();
+    face_patch_out.assign( num_faces, -1 );
+    if( 0 == num_faces ) return 0;
+
+    // Face centroids, used only to spread the seeds out.
+    std::vector< float > centroids( 3*num_faces );
+    for( index_t fi = 0; fi < num_faces; ++fi )
+    {
+        index_t v[3];
+        face_vertices( mesh, fi, v );
+        centroids[3*fi+0] = ( vertices[v[0]].x + vertices[v[1]].x + vertices[v[2]].x ) / 3.f;
+        centroids[3*fi+1] = ( vertices[v[0]].y + vertices[v[1]].y + vertices[v[2]].y ) / 3.f;
+        centroids[3*fi+2] = ( vertices[v[0]].z + vertices[v[1]].z + vertices[v[2]].z ) / 3.f;
+    }
+
+    // Farthest-point sampling: each seed is the face farthest from all seeds so far.
+    // Every seed costs one pass over the candidates, so on large meshes only an
+    // evenly strided subset of at most max_seed_candidates faces is considered,
+    // bounding the sampling at O(K * max_seed_candidates).
+    const index_t max_seed_candidates = 1 << 16;
+    const index_t candidate_stride = std::max< index_t >( 1, num_faces / max_seed_candidates );
+    std::vector< index_t > candidates;
+    for( index_t fi = 0; fi < num_faces; fi += candidate_stride ) candidates.push_back( fi );
+    // K never exceeds the number of candidates: there are at least min( num_faces, max_seed_candidates ) of them.
+    const index_t num_candidates = candidates.size();
+    const index_t K = std::max< index_t >( 1, std::min< index_t >( num_patches, num_candidates ) );
+    const index_t capacity = ( num_faces + K - 1 ) / K;
+
+    std::vector< index_t > seeds;
+    seeds.reserve( K );
+    std::vector< float > seed_distance( num_candidates, std::numeric_limits< float >::max() );
+    index_t next_seed = 0;
+    while( static_cast< index_t >( seeds.size() ) < K )
+    {
+        const index_t seed = candidates[ next_seed ];
+        seeds.push_back( seed );
+        // Never pick a face twice, even when centroids coincide.
+        seed_distance[ next_seed ] = -1.f;
+
+        float farthest = -1.f;
+        for( index_t ci = 0; ci < num_candidates; ++ci )
+        {
+            const index_t fi = candidates[ci];
+            const float dx = centroids[3*fi+0] - centroids[3*seed+0];
+            const float dy = centroids[3*fi+1] - centroids[3*seed+1];
+            const float dz = centroids[3*fi+2] - centroids[3*seed+2];
+            seed_distance[ci] = std::min( seed_distance[ci], dx*dx + dy*dy + dz*dz );
+            if( seed_distance[ci] > farthest )
+            {
+                farthest = seed_distance[ci];
+                next_seed = ci;
+            }
+        }
+    }
+
+    // Grow all patches breadth-first across face-face adjacency, always extending
+    // the smallest patch that still has a frontier.  A patch stops growing at
+    // 'capacity' faces, which keeps the sizes balanced.
+    // Patches only ever take faces from their frontier, i.e. edge-adjacent to a face
+    // they already own; this keeps every patch edge-connected within each connected
+    // component it was started in.
+    // The heap holds (size, patch) entries; entries whose size is out of date are skipped.
+    typedef std::pair< index_t, index_t > size_patch_t;
+    std::priority_queue< size_patch_t, std::vector< size_patch_t >, std::greater< size_patch_t > > smallest;
+    std::vector< std::deque< index_t > > frontiers( K );
+    std::vector< index_t > sizes( K, 0 );
+    // Number of faces each patch was started from (its seed, plus one per seedless component).
+    std::vector< index_t > starts( K, 1 );
+    for( index_t p = 0; p < K; ++p )
+    {
+        frontiers[p].push_back( seeds[p] );
+        smallest.push( { 0, p } );
+    }
+
+    // Once no patch under capacity can grow, the remaining faces are handed to adjacent
+    // patches regardless of capacity, rather than to a patch elsewhere on the mesh.
+    bool past_capacity = false;
+    index_t num_assigned = 0;
+    index_t unassigned_scan = 0;
+    while( num_assigned < num_faces )
+    {
+        if( smallest.empty() && !past_capacity )
+        {
+            // Every patch is either full or boxed in.  Let all patches with a frontier
+            // take their unassigned neighbors.
+            past_capacity = true;
+            for( index_t p = 0; p < K; ++p )
+            {
+                if( !frontiers[p].empty() ) smallest.push( { sizes[p], p } );
+            }
+        }
+        if( smallest.empty() )
+        {
+            // No patch borders an unassigned face: the remaining faces belong to
+            // connected components without a seed.  Start the smallest patch in the next one.
+            while( -1 != face_patch_out[ unassigned_scan ] ) ++unassigned_scan;
+            const index_t p = std::min_element( sizes.begin(), sizes.end() ) - sizes.begin();
+            frontiers[p].push_back( unassigned_scan );
+            ++starts[p];
+            smallest.push( { sizes[p], p } );
+        }
+
+        const size_patch_t top = smallest.top();
+        smallest.pop();
+        const index_t p = top.second;
+        if( top.first != sizes[p] ) continue;
+
+        std::deque< index_t >& frontier = frontiers[p];
+        while( !frontier.empty() && -1 != face_patch_out[ frontier.front() ] ) frontier.pop_front();
+        if( frontier.empty() ) continue;
+
+        const index_t fi = frontier.front();
+        frontier.pop_front();
+        face_patch_out[fi] = p;
+        ++sizes[p];
+        ++num_assigned;
+
+        index_t neighbors[3];
+        face_face_neighbors( mesh, fi, neighbors );
+        for( int i = 0; i < 3; ++i )
+        {
+            if( -1 != neighbors[i] && -1 == face_patch_out[ neighbors[i] ] ) frontier.push_back( neighbors[i] );
+        }
+
+        if( past_capacity || sizes[p] < capacity ) smallest.push( { sizes[p], p } );
+    }
+
+#ifndef NDEBUG
+    // Every patch consists of at most as many edge-connected pieces as it was started from.
+    std::vector< bool > visited( num_faces, false );
+    std::vector< index_t > pieces( K, 0 );
+    std::vector< index_t > stack;
+    for( index_t f0 = 0; f0 < num_faces; ++f0 )
+    {
+        if( visited[f0] ) continue;
+        ++pieces[ face_patch_out[f0] ];
+        visited[f0] = true;
+        stack.push_back( f0 );
+        while( !stack.empty() )
+        {
+            const index_t fi = stack.back();
+            stack.pop_back();
+
+            index_t neighbors[3];
+            face_face_neighbors( mesh, fi, neighbors );
+            for( int i = 0; i < 3; ++i )
+            {
+                const index_t fj = neighbors[i];
+                if( -1 != fj && !visited[fj] && face_patch_out[fj] == face_patch_out[fi] )
+                {
+                    visited[fj] = true;
+                    stack.push_back( fj );
+                }
+            }
+        }
+    }
+    for( index_t p = 0; p < K; ++p )
+    {
+        assert( pieces[p] <= starts[p] );
+    }
+#endif
+
+    return K;
+}
+}
+
+namespace trimesh
+{
+
+void partition_faces( const trimesh_t& mesh, const unsigned long num_patches, std::vector< index_t >& face_patch_out )
+{
+    ::partition_faces( mesh, vertex_data_array( mesh ), num_patches, face_patch_out );
+}
+
+void partition_mesh( const trimesh_t& mesh, const unsigned long num_patches, mesh_partition_t& partition_out )
+{
+    const std::vector< vertex_t > vertices = vertex_data_array( mesh );
+    const index_t K = ::partition_faces( mesh, vertices, num_patches, partition_out.face_patch );
+    const std::vector< index_t >& face_patch = partition_out.face_patch;
+
+    const index_t num_faces = mesh.num_faces();
+
+    partition_out.patches.clear();
+    partition_out.patches.resize( K );
+
+    // A vertex is on a patch interface if its faces belong to more than one patch.
+    std::vector< index_t > vertex_patch( vertices.size(), -1 );
+    std::vector< bool > vertex_is_interface( vertices.size(), false );
+    for( index_t fi = 0; fi < num_faces; ++fi )
+    {
+        index_t v[3];
+        face_vertices( mesh, fi, v );
+        for( int i = 0; i < 3; ++i )
+        {
+            if( -1 == vertex_patch[ v[i] ] ) vertex_patch[ v[i] ] = face_patch[fi];
+            else if( vertex_patch[ v[i] ] != face_patch[fi] ) vertex_is_interface[ v[i] ] = true;
+        }
+
+        partition_out.patches[ face_patch[fi] ].face_local2global.push_back( fi );
+    }
+
+    // The faces around every vertex, as offsets into one array (vertex vi's faces are
+    // vertex_faces[ vertex_face_offsets[vi] .. vertex_face_offsets[vi+1] ) ).
+    // Unlike vertex_face_neighbors(), this also sees every wing of a butterfly vertex.
+    std::vector< index_t > vertex_face_offsets( vertices.size() + 1, 0 );
+    for( index_t fi = 0; fi < num_faces; ++fi )
+    {
+        index_t v[3];
+        face_vertices( mesh, fi, v );
+        for( int i = 0; i < 3; ++i ) ++vertex_face_offsets[ v[i] + 1 ];
+    }
+    for( size_t vi = 0; vi < vertices.size(); ++vi ) vertex_face_offsets[ vi + 1 ] += vertex_face_offsets[ vi ];
+    std::vector< index_t > vertex_faces( vertex_face_offsets.back() );
+    {
+        std::vector< index_t > fill( vertex_face_offsets.begin(), vertex_face_offsets.end() - 1 );
+        for( index_t fi = 0; fi < num_faces; ++fi )
+        {
+            index_t v[3];
+            face_vertices( mesh, fi, v );
+            for( int i = 0; i < 3; ++i ) vertex_faces[ fill[ v[i] ]++ ] = fi;
+        }
+    }
+
+    // Build every patch, reusing one workspace and one global-to-local vertex map.
+    build_workspace_t workspace;
+    std::vector< index_t > vertex_global2local( vertices.size(), -1 );
+    for( index_t p = 0; p < K; ++p )
+    {
+        mesh_patch_t& patch = partition_out.patches[p];
+
+        std::vector< vertex_t >& patch_vertices = workspace.vertices;
+        std::vector< triangle_t >& patch_triangles = workspace.triangles;
+        patch_vertices.clear();
+        patch_triangles.clear();
+        patch_triangles.reserve( patch.face_local2global.size() );
+
+        for( const index_t fi : patch.face_local2global )
+        {
+            index_t v[3];
+            face_vertices( mesh, fi, v );
+
+            triangle_t tri;
+            for( int i = 0; i < 3; ++i )
+            {
+                if( -1 == vertex_global2local[ v[i] ] )
+                {
+                    vertex_global2local[ v[i] ] = patch.vertex_local2global.size();
+                    patch.vertex_local2global.push_back( v[i] );
+                    patch_vertices.push_back( vertices[ v[i] ] );
+                    if( vertex_is_interface[ v[i] ] )
+                    {
+                        patch.interface_vertices.push_back( vertex_global2local[ v[i] ] );
+                        // The halo is the rest of the interface vertex's one-ring.
+                        for( index_t k = vertex_face_offsets[ v[i] ]; k < vertex_face_offsets[ v[i] + 1 ]; ++k )
+                        {
+                            if( face_patch[ vertex_faces[k] ] != p ) patch.halo_faces.push_back( vertex_faces[k] );
+                        }
+                    }
+                }
+                tri.v[i] = vertex_global2local[ v[i] ];
+            }
+            patch_triangles.push_back( tri );
+        }
+
+        std::sort( patch.halo_faces.begin(), patch.halo_faces.end() );
+        patch.halo_faces.erase( std::unique( patch.halo_faces.begin(), patch.halo_faces.end() ), patch.halo_faces.end() );
+
+        // Reset only the entries this patch touched.
+        for( const index_t vi : patch.vertex_local2global ) vertex_global2local[ vi ] = -1;
+
+        unordered_edges_from_triangles( patch_triangles.size(), patch_triangles.data(), workspace.edges, workspace );
+        patch.mesh.build( patch_vertices.size(), patch_vertices.data(), patch_triangles.size(), patch_triangles.data(), workspace.edges.size(), workspace.edges.data(), workspace );
+    }
+}
+
+}